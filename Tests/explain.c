@@ -0,0 +1,82 @@
+#include "../regex.h"
+
+#define COLOR_GREEN "\033[0;32m"
+#define COLOR_RED "\033[0;31m"
+#define COLOR_RESET "\033[0m"
+
+typedef struct explain_test {
+    char *pattern;
+    int engine;
+    int anchoredBegin;
+    int anchoredEnd;
+    int backtrackingRisk;
+    int minLength;
+    char *literal;
+} explain_test;
+
+explain_test test_explain[] =
+{
+    /* Plain text - searched with strstr */
+    {"error", REGEX_ENGINE_LITERAL, 0, 0, 0, 5, "error"},
+    {"^GET /", REGEX_ENGINE_LITERAL, 1, 0, 0, 5, "GET /"},
+    {"done$", REGEX_ENGINE_LITERAL, 0, 1, 0, 4, "done"},
+    {"www\\.example", REGEX_ENGINE_LITERAL, 0, 0, 0, 11, "www.example"},
+
+    /* Backtracking, with the literal prefix to skip to */
+    {"https?://\\S+", REGEX_ENGINE_BACKTRACK, 0, 0, 0, 8, "http"},
+    {"id=\\d+", REGEX_ENGINE_BACKTRACK, 0, 0, 0, 4, "id="},
+    {"\\d\\d?:\\d\\d", REGEX_ENGINE_BACKTRACK, 0, 0, 0, 4, ""},
+    {"^\\w+", REGEX_ENGINE_BACKTRACK, 1, 0, 0, 1, ""},
+    {"a?a?a?aaa", REGEX_ENGINE_BACKTRACK, 0, 0, 1, 3, ""},
+    {"", REGEX_ENGINE_BACKTRACK, 0, 0, 0, 0, ""},
+
+    /* The risk depends on whether the quantifiers can match the same characters, not on how many there are */
+    {"\\d?-?\\d?", REGEX_ENGINE_BACKTRACK, 0, 0, 1, 0, ""},
+    {"a?aa?", REGEX_ENGINE_BACKTRACK, 0, 0, 1, 1, ""},
+    {"\\w+\\s?\\w?", REGEX_ENGINE_BACKTRACK, 0, 0, 1, 1, ""},
+    {"a?xa?x", REGEX_ENGINE_BACKTRACK, 0, 0, 0, 2, ""},
+    {"a?b?c?", REGEX_ENGINE_BACKTRACK, 0, 0, 0, 0, ""},
+
+    /* Several unbounded quantifiers - linear time automaton, which never backtracks */
+    {"a*a*a*b", REGEX_ENGINE_AUTOMATON, 0, 0, 0, 1, ""},
+    {"\\w+@\\w+\\.com", REGEX_ENGINE_AUTOMATON, 0, 0, 0, 7, ""},
+    {"^.*\\\\.*$", REGEX_ENGINE_AUTOMATON, 1, 1, 0, 1, ""},
+    {"key: \\s*\\S+$", REGEX_ENGINE_AUTOMATON, 0, 1, 0, 6, "key: "},
+};
+
+void regex_print(regex_t);
+
+int main()
+{
+    int ntests = sizeof(test_explain) / sizeof(*test_explain);
+    int nfailed = 0;
+    int i;
+
+    for (i = 0; i < ntests; ++i)
+    {
+        explain_test *test = &test_explain[i];
+        regex_info info = regex_explain(regex_compile(test->pattern));
+
+        if (info.engine != test->engine || info.anchoredBegin != test->anchoredBegin || info.anchoredEnd != test->anchoredEnd ||
+            info.backtrackingRisk != test->backtrackingRisk || info.minLength != test->minLength || strcmp(info.literal, test->literal) != 0)
+        {
+            printf(COLOR_RED);
+            printf("[%d/%d]: pattern '%s'\n", (i + 1), ntests, test->pattern);
+            printf("Result: %s ^%d $%d risk %d min %d literal '%s'\n", regex_engine_name(info.engine), info.anchoredBegin, info.anchoredEnd, info.backtrackingRisk, info.minLength, info.literal);
+            printf("Expected: %s ^%d $%d risk %d min %d literal '%s'\n\n", regex_engine_name(test->engine), test->anchoredBegin, test->anchoredEnd, test->backtrackingRisk, test->minLength, test->literal);
+            nfailed++;
+        }
+        else
+        {
+            printf(COLOR_GREEN);
+            printf("[%d/%d]: pattern '%s' runs on %s\n", (i + 1), ntests, test->pattern, regex_engine_name(info.engine));
+        }
+    }
+
+    printf(COLOR_RESET);
+    printf(COLOR_GREEN "%d/%d test cases passed.\n" COLOR_RESET, ntests - nfailed, ntests);
+    if(nfailed)
+        printf(COLOR_RED "%d/%d test cases failed.\n" COLOR_RESET, nfailed, ntests);
+
+    return nfailed;
+}
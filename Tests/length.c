@@ -198,6 +198,23 @@ char *test_vector[][4] = {
         {NOK, "X?Y", "Z", (char *)0},
         {OK, "[a-z]+\nbreak", "blahblah\nbreak", (char *)14},
         {OK, "[a-z\\s]+\nbreak", "bla bla \nbreak", (char *)14},
+
+        /* A failed quantifier after literal characters no longer adds those characters to the length */
+        {OK, "ab*c", "abd abc", (char *)3},
+        {OK, "a\\d+b", "a12c a1b", (char *)3},
+        {OK, "\\d\\d:\\d+x", "12:34 12:5x", (char *)5},
+        {OK, "[^a]$", "xyz", (char *)1},
+
+        /* Several unbounded quantifiers on long texts - these run on the automaton */
+        {NOK, "a*a*a*a*a*a*a*a*a*b", "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa", (char *)0},
+        {OK, "a*a*a*a*a*a*a*a*a*b", "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaab", (char *)81},
+        {NOK, "\\w+\\w+\\w+\\w+\\w+\\w+\\w+\\w+!", "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa", (char *)0},
+        {OK, "x\\w*\\w*\\w*y?", "the xaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa end", (char *)81},
+
+        /* Chains of '?' on long texts - these stay on the backtracking engine and are memoized */
+        {NOK, "a?a?a?a?a?a?a?a?a?aaaaaaaaa", "aaaaaaaabbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb", (char *)0},
+        {OK, "a?a?a?a?a?a?a?a?a?aaaaaaaaa", "bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbaaaaaaaaaaaa", (char *)9},
+        {OK, "\\d?\\d?\\d?\\d?\\d?\\d?-\\d", "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx123456-7", (char *)8},
 };
 
 void regex_print(regex_t);
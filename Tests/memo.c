@@ -0,0 +1,105 @@
+#include "../regex.h"
+#include <time.h>
+
+#define COLOR_GREEN "\033[0;32m"
+#define COLOR_RED "\033[0;31m"
+#define COLOR_RESET "\033[0m"
+
+// Benchmark style checks for the memoization: a find-all loop must cost about the same with and without it,
+// and backtracking that would blow up must finish quickly with it
+
+typedef struct memo_test {
+    char *name;
+    char *pattern;
+    char *text;
+    int expected;   // matches the find-all loop has to find
+    int compareOff; // also time the loop without memoization, only for patterns that do not blow up
+} memo_test;
+
+// runs regex_match_compiled_pattern over the whole text like a find-all loop does, returns the number of matches
+static int find_all(regex_t pattern, const char *text, double *seconds)
+{
+    clock_t start = clock();
+    size_t offset = 0;
+    int nmatches = 0;
+    int length;
+    int position;
+
+    while (text[offset] != '\0' && (position = regex_match_compiled_pattern(pattern, text + offset, &length)) >= 0)
+    {
+        nmatches++;
+        offset += position + (length > 0 ? length : 1);
+    }
+    *seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    return nmatches;
+}
+
+static char *repeat(const char *piece, size_t count)
+{
+    size_t length = strlen(piece);
+    char *text = (char *)malloc(length * count + 1);
+    for (size_t i = 0; i < count; i++)
+        memcpy(text + i * length, piece, length);
+    text[length * count] = '\0';
+    return text;
+}
+
+int main()
+{
+    char risky[64] = ""; // a?a?...a?ab, as many '?' as fit into MAX_REGEXP_OBJECTS
+    for (int i = 0; i < 13; i++)
+        strcat(risky, "a?");
+    strcat(risky, "ab");
+
+    memo_test tests[] =
+    {
+        /* ordinary patterns with a few quantifiers, most searches end right at their match */
+        {"urls in a log", "https?://\\S+", repeat("GET https://example.com/index.html 200\n", 20000), 20000, 1},
+        {"short matches", "7x?x?", repeat("7xxx", 250000), 250000, 1},
+        /* there is no 'b', plain backtracking tries about 2^13 ways at every position */
+        {"blow up", risky, repeat("a", 2000), 0, 0},
+        /* the same over a text much longer than REGEX_MEMO_MAX_SPAN */
+        {"blow up in a long text", risky, repeat("a", 200000), 0, 0},
+    };
+    int ntests = sizeof(tests) / sizeof(*tests);
+    int nfailed = 0;
+
+    for (int i = 0; i < ntests; ++i)
+    {
+        memo_test *test = &tests[i];
+        regex_t pattern = regex_compile(test->pattern);
+        double memoized, plain = 0;
+
+        regex_set_memoization(REGEX_MEMO_AUTO);
+        int nmatches = find_all(pattern, test->text, &memoized);
+        int nplain = test->expected;
+        if (test->compareOff)
+        {
+            regex_set_memoization(REGEX_MEMO_OFF);
+            nplain = find_all(pattern, test->text, &plain);
+            regex_set_memoization(REGEX_MEMO_AUTO);
+        }
+
+        // generous limits, the memoization used to make the first two take 100 times longer
+        if (nmatches != test->expected || nplain != test->expected || memoized > 3 * plain + 0.5)
+        {
+            printf(COLOR_RED);
+            printf("[%d/%d]: %s, '%s' found %d matches in %.3fs, without memoization %d in %.3fs, expected %d\n",
+                   i + 1, ntests, test->name, test->pattern, nmatches, memoized, nplain, plain, test->expected);
+            nfailed++;
+        }
+        else
+        {
+            printf(COLOR_GREEN);
+            printf("[%d/%d]: %s, '%s' found %d matches in %.3fs\n", i + 1, ntests, test->name, test->pattern, nmatches, memoized);
+        }
+        free(test->text);
+    }
+
+    printf(COLOR_RESET);
+    printf(COLOR_GREEN "%d/%d test cases passed.\n" COLOR_RESET, ntests - nfailed, ntests);
+    if(nfailed)
+        printf(COLOR_RED "%d/%d test cases failed.\n" COLOR_RESET, nfailed, ntests);
+
+    return nfailed;
+}
@@ -0,0 +1,105 @@
+#include "../regex.h"
+
+#define OK ((char *)1)
+#define NOK ((char *)0)
+
+#define COLOR_GREEN "\033[0;32m"
+#define COLOR_RED "\033[0;31m"
+#define COLOR_RESET "\033[0m"
+
+#define MAX_LINE_MATCHES 16
+
+// every matching line is written as "line:position:length", separated by spaces
+char *test_lines[][4] =
+{
+    /* Unanchored patterns report every line that contains a match */
+    {OK, "error", "ok\nerror: disk\nok\nanother error\n", "2:3:5 4:26:5"},
+    {OK, "\\d+", "a1\nb\nc22", "1:1:1 3:6:2"},
+    {OK, "o+", "foo\nboo", "1:1:2 2:5:2"},
+
+    /* Only the leftmost match of a line is reported */
+    {OK, "a", "aaa\nbab", "1:0:1 2:5:1"},
+
+    /* Begin anchor (^) - Matches at the start of every line */
+    {OK, "^WARN", "INFO start\nWARN low disk\nINFO x WARN\nWARN again", "2:11:4 4:37:4"},
+    {OK, "^\\s+at ", "Exception\n    at main\n    at run\ndone", "2:10:7 3:22:7"},
+
+    /* End anchor ($) - Matches at the end of every line */
+    {OK, "\\d$", "abc1\nabc\n22", "1:3:1 3:10:1"},
+    {OK, "^$", "a\n\nb\n\n", "2:2:0 4:5:0"},
+    {OK, "^\\w+:\\d+$", "host:80\nbad line\nlocal:8080", "1:0:7 3:17:10"},
+
+    /* The last line matches at its end even without a trailing newline */
+    {OK, "$", "abc\ndef", "1:3:0 2:7:0"},
+    {OK, "x*$", "ab\nx", "1:2:0 2:3:1"},
+    {OK, "x*$", "ab\ncd", "1:2:0 2:5:0"},
+    {OK, "c?$", "ab\nde", "1:2:0 2:5:0"},
+    {OK, "\\d*$", "a1\nb\n", "1:1:1 2:4:0"},
+
+    /* Lines are counted correctly across long runs without matches */
+    {OK, "^x", "a\nb\nc\nd\ne\nf\nx", "7:12:1"},
+
+    /* No match at all */
+    {NOK, "fatal", "ok\nerror\nwarning\n", ""},
+    {NOK, "^error", "an error\nsome error", ""},
+    {NOK, "abc", "", ""},
+};
+
+void regex_print(regex_t);
+
+int main()
+{
+    char *pattern;
+    char *text;
+    char *expected;
+    char result[256];
+    regex_line_match matches[MAX_LINE_MATCHES];
+    int ntests = sizeof(test_lines) / sizeof(*test_lines);
+    int nfailed = 0;
+    int i, j;
+
+    for (i = 0; i < ntests; ++i)
+    {
+        pattern = test_lines[i][1];
+        text = test_lines[i][2];
+        expected = test_lines[i][3];
+
+        int nmatches = regex_match_lines(pattern, text, matches, MAX_LINE_MATCHES);
+
+        result[0] = '\0';
+        for (j = 0; j < nmatches && j < MAX_LINE_MATCHES; j++)
+        {
+            char entry[32];
+            sprintf(entry, "%s%d:%d:%d", j ? " " : "", matches[j].line, matches[j].position, matches[j].length);
+            strcat(result, entry);
+        }
+
+        int should_fail = (test_lines[i][0] == NOK);
+        if (should_fail != (nmatches == 0) || strcmp(result, expected) != 0)
+        {
+            printf(COLOR_RED);
+            printf("[%d/%d]: pattern '%s'\nResult: '%s'\nExpected: '%s'\n\n", (i + 1), ntests, pattern, result, expected);
+            nfailed++;
+        }
+        else
+        {
+            printf(COLOR_GREEN);
+            printf("[%d/%d]: pattern '%s'\nResult: '%s'\n\n", (i + 1), ntests, pattern, result);
+        }
+    }
+
+    /* the return value counts all matching lines even when they do not fit into the buffer */
+    int ncounted = regex_match_lines("b", "b\nb\nb", NULL, 0);
+    if (ncounted != 3)
+    {
+        printf(COLOR_RED "counting without a buffer returned %d lines, expected 3\n\n", ncounted);
+        nfailed++;
+    }
+
+    printf(COLOR_RESET);
+    printf(COLOR_GREEN "%d/%d test cases passed.\n" COLOR_RESET, ntests + 1 - nfailed, ntests + 1);
+    if(nfailed)
+        printf(COLOR_RED "%d/%d test cases failed.\n" COLOR_RESET, nfailed, ntests + 1);
+
+    return nfailed;
+}
@@ -43,6 +43,11 @@ char *test_replace[][5] =
     {OK, "cat", "dog", "I have a cat and a cat.", "I have a dog and a dog."},
     {NOK, "not_in_text", "replace", "No match here", "No match here"},
     {OK, "[0-9]+", "#", "The numbers are 123 and 456", "The numbers are # and #"},
+
+    /* Lengths of matches found after a failed attempt only count the matched characters */
+    {OK, "ab*c", "X", "abd abc", "abd X"},
+    {OK, "[^a]$", "#", "b1.", "b1#"},
+    {OK, "x\\w+b[ab]*\\s?", "#", "xx .axxb ", "xx .a# "},
 };
 
 void regex_print(regex_t);
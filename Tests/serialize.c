@@ -0,0 +1,216 @@
+#include "../regex.h"
+#include <stddef.h>
+
+#define COLOR_GREEN "\033[0;32m"
+#define COLOR_RED "\033[0;31m"
+#define COLOR_RESET "\033[0m"
+
+#define IMAGE_FILE "serialize_test.bin"
+
+// every pattern is saved into one file, loaded back and matched against the text
+char *test_patterns[][3] =
+{
+    {"error", "disk error on sda", (char *)5},
+    {"^GET /\\w*", "GET /index HTTP/1.1", (char *)10},
+    {"https?://\\S+", "Visit https://example.com", (char *)19},
+    {"\\w+@\\w+\\.com", "my email is mehmood@email.com", (char *)17},
+    {"[^abc]+def", "xyzdef", (char *)6},
+    {"\\d\\d?:\\d\\d?:\\d\\d?", "at 00:0:00 today", (char *)6},
+    {"a*a*a*b", "aaaab", (char *)5},
+};
+
+void regex_print(regex_t);
+
+/* images changed on purpose get a new checksum, so only the checks on the program itself can catch them */
+static void reseal(unsigned char *image)
+{
+    regex_image_header *header = (regex_image_header *)image;
+    unsigned char *bytes = image + sizeof(regex_image_header);
+    uint32_t hash = 2166136261u;
+    size_t i;
+
+    for (i = 0; i < sizeof(regex_program); i++)
+    {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    header->checksum = hash;
+}
+
+int main()
+{
+    int npatterns = sizeof(test_patterns) / sizeof(*test_patterns);
+    int ntests = 0;
+    int nfailed = 0;
+    int i;
+
+    /* compile once and write all images into one file */
+    FILE *file = fopen(IMAGE_FILE, "wb");
+    if (!file)
+    {
+        perror("Failed to create " IMAGE_FILE);
+        return 1;
+    }
+    for (i = 0; i < npatterns; ++i)
+    {
+        unsigned char image[REGEX_IMAGE_SIZE];
+        size_t size = regex_save(regex_compile(test_patterns[i][0]), image, sizeof(image));
+        fwrite(image, 1, size, file);
+    }
+    fclose(file);
+
+    /* read the file back, the images are used in place */
+    size_t bundleSize = npatterns * REGEX_IMAGE_SIZE;
+    uint32_t *bundle = (uint32_t *)malloc(bundleSize);
+    file = fopen(IMAGE_FILE, "rb");
+    if (!bundle || !file || fread(bundle, 1, bundleSize, file) != bundleSize)
+    {
+        printf(COLOR_RED "Failed to read " IMAGE_FILE "\n" COLOR_RESET);
+        return 1;
+    }
+    fclose(file);
+    remove(IMAGE_FILE);
+
+    for (i = 0; i < npatterns; ++i)
+    {
+        char *pattern = test_patterns[i][0];
+        char *text = test_patterns[i][1];
+        int expected = (int)(intptr_t)test_patterns[i][2];
+        int length = 0;
+
+        regex_t loaded = regex_load((char *)bundle + i * REGEX_IMAGE_SIZE, REGEX_IMAGE_SIZE);
+        int m = loaded ? regex_match_compiled_pattern(loaded, text, &length) : -1;
+        ntests++;
+        if (loaded == NULL || m == -1 || length != expected)
+        {
+            printf(COLOR_RED);
+            printf("[%d]: pattern '%s' loaded %s, matched %d chars of '%s'; expected %d\n", ntests, pattern, loaded ? "ok" : "failed", length, text, expected);
+            nfailed++;
+        }
+        else
+        {
+            printf(COLOR_GREEN);
+            printf("[%d]: pattern '%s' loaded and matched '%s' as expected\n", ntests, pattern, text);
+        }
+    }
+
+    /* damaged or foreign images are rejected */
+    unsigned char *first = (unsigned char *)bundle;
+    struct
+    {
+        char *name;
+        size_t offset;
+        size_t size;
+    } broken[] =
+    {
+        {"truncated image", 0, REGEX_IMAGE_SIZE - 1},
+        {"wrong magic", 0, REGEX_IMAGE_SIZE},
+        {"wrong version", offsetof(regex_image_header, version), REGEX_IMAGE_SIZE},
+        {"flipped byte in the tokens", sizeof(regex_image_header) + 3, REGEX_IMAGE_SIZE},
+        {"flipped byte in the info", sizeof(regex_image_header) + offsetof(regex_program, info), REGEX_IMAGE_SIZE},
+    };
+    int nbroken = sizeof(broken) / sizeof(*broken);
+    for (i = 0; i < nbroken; ++i)
+    {
+        unsigned char saved = first[broken[i].offset];
+        if (broken[i].size == REGEX_IMAGE_SIZE)
+            first[broken[i].offset] ^= 0x5a;
+        regex_t loaded = regex_load(first, broken[i].size);
+        first[broken[i].offset] = saved;
+
+        ntests++;
+        if (loaded != NULL)
+        {
+            printf(COLOR_RED "[%d]: %s was loaded\n", ntests, broken[i].name);
+            nfailed++;
+        }
+        else
+        {
+            printf(COLOR_GREEN "[%d]: %s was rejected\n", ntests, broken[i].name);
+        }
+    }
+
+    /* forged images with a valid checksum are rejected too */
+    uint32_t forgedStorage[REGEX_IMAGE_SIZE / sizeof(uint32_t) + 1];
+    unsigned char *forged = (unsigned char *)forgedStorage;
+    regex_program *program = (regex_program *)(forged + sizeof(regex_image_header));
+    char *forgeries[] =
+    {
+        "resealed copy", /* not forged, checks that reseal works */
+        "info does not match the tokens",
+        "garbage after the last token",
+        "garbage after the literal",
+        "empty tokens anchored at the beginning with garbage",
+        "character 0 in the tokens",
+        "character 0 in the tokens with a literal that ends before it",
+        "unpaired '\\' at the end of a class",
+        "literal that is not the start of the pattern",
+    };
+    int nforgeries = sizeof(forgeries) / sizeof(*forgeries);
+    for (i = 0; i < nforgeries; ++i)
+    {
+        memcpy(forged, first, REGEX_IMAGE_SIZE);
+        if (i == 5 || i == 6)
+        {
+            /* the literal search would read past the end of the text */
+            regex_save(regex_compile("axxxxxxxxxxxxxxx"), forged, REGEX_IMAGE_SIZE);
+            program->tokens[1].u.ch = '\0';
+        }
+        if (i == 6)
+        {
+            memset(program->info.literal + 1, 0, sizeof(program->info.literal) - 1);
+            program->info.literalLength = 1;
+            program->info.engine = REGEX_ENGINE_BACKTRACK;
+        }
+        if (i == 7)
+        {
+            /* matchSingleCharacter would skip the terminating 0 together with the '\\' */
+            regex_save(regex_compile("[abcdefghijklmnopqrstuvwxyz0123456789AB]"), forged, REGEX_IMAGE_SIZE);
+            program->tokens[0].u.char_class[38] = '\\';
+        }
+        if (i == 8)
+            program->info.literal[0] = 'E';
+        if (i == 1 || i == 4)
+        {
+            program->tokens[0].type = UNUSED;
+            program->info.anchoredBegin = 1;
+        }
+        if (i == 2 || i == 4)
+            program->tokens[MAX_REGEXP_OBJECTS - 1].u.ch = 'x';
+        if (i == 3 || i == 4)
+            program->info.literal[program->info.literalLength + 1] = 'x';
+        reseal(forged);
+
+        regex_t loaded = regex_load(forged, REGEX_IMAGE_SIZE);
+        ntests++;
+        if ((loaded != NULL) != (i == 0))
+        {
+            printf(COLOR_RED "[%d]: %s was %s\n", ntests, forgeries[i], loaded ? "loaded" : "rejected");
+            nfailed++;
+        }
+        else
+        {
+            printf(COLOR_GREEN "[%d]: %s was %s\n", ntests, forgeries[i], loaded ? "loaded" : "rejected");
+        }
+    }
+
+    /* the same pattern always gives the same image */
+    unsigned char again[REGEX_IMAGE_SIZE];
+    regex_compile("[0-9a-z\\s]+ some long pattern");
+    regex_save(regex_compile(test_patterns[0][0]), again, sizeof(again));
+    ntests++;
+    if (memcmp(again, first, REGEX_IMAGE_SIZE) != 0)
+    {
+        printf(COLOR_RED "[%d]: saving the same pattern twice gave different images\n", ntests);
+        nfailed++;
+    }
+
+    free(bundle);
+
+    printf(COLOR_RESET);
+    printf(COLOR_GREEN "%d/%d test cases passed.\n" COLOR_RESET, ntests - nfailed, ntests);
+    if(nfailed)
+        printf(COLOR_RED "%d/%d test cases failed.\n" COLOR_RESET, nfailed, ntests);
+
+    return nfailed;
+}
@@ -0,0 +1,265 @@
+#include "../regex.h"
+#include <pthread.h>
+
+#define COLOR_GREEN "\033[0;32m"
+#define COLOR_RED "\033[0;31m"
+#define COLOR_RESET "\033[0m"
+
+// build with -DREGEX_ENABLE_STATS for the counters, without it the test checks that nothing is collected
+
+typedef struct stats_test {
+    char *pattern;
+    char *text;
+    int nsearches;
+    regex_stats expected; // id and digest are not compared
+} stats_test;
+
+stats_test test_stats[] =
+{
+    /* literal prefix skips "user " and the matcher runs once */
+    {"id=\\d+", "user id=42", 1, {0, 0, 1, 5, 1, 2, 0, 5, 0}},
+    /* no prefix, every position is tried and '*' gives back characters */
+    {"\\d*y", "12z", 1, {0, 0, 1, 3, 4, 11, 3, 0, 0}},
+    /* plain text, strstr finds it right away */
+    {"error", "error: disk", 1, {0, 0, 1, 5, 1, 0, 0, 0, 0}},
+    /* the automaton looks at every character once */
+    {"a*a*b", "xaab", 1, {0, 0, 1, 4, 4, 0, 0, 0, 0}},
+    /* counters add up over several searches */
+    {"^GET", "GET /", 3, {0, 0, 3, 9, 3, 0, 0, 0, 0}},
+};
+
+void regex_print(regex_t);
+
+/* workers search these patterns, then stay alive until main has read the counters */
+#define NWORKERS 4
+#define NWORKER_SEARCHES 50
+#define NWORKER_PATTERNS (REGEX_STATS_PENDING + 2)
+static regex_t workerPatterns[NWORKER_PATTERNS];
+static pthread_mutex_t workerLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t workerCond = PTHREAD_COND_INITIALIZER;
+static int workersDone = 0;
+static int workersReleased = 0;
+
+static void *worker(void *unused)
+{
+    int length;
+    (void)unused;
+    for (int j = 0; j < NWORKER_SEARCHES; ++j)
+        for (int i = 0; i < NWORKER_PATTERNS; ++i)
+            regex_match_compiled_pattern(workerPatterns[i], "user id=42", &length);
+
+    pthread_mutex_lock(&workerLock);
+    workersDone++;
+    pthread_cond_broadcast(&workerCond);
+    while (!workersReleased)
+        pthread_cond_wait(&workerCond, &workerLock);
+    pthread_mutex_unlock(&workerLock);
+    return NULL;
+}
+
+/* every worker pattern has to be counted exactly, with the statistics compiled out nothing may be */
+static int workers_counted(void)
+{
+    regex_stats stats;
+    regex_stats collected[64]; // resetting keeps the entries of the earlier patterns, collect still lists them
+    int ncollected = regex_stats_collect(collected, 64);
+    int ok = (ncollected <= 64 && regex_stats_dropped() == 0);
+    for (int i = 0; i < NWORKER_PATTERNS; ++i)
+    {
+        int found = regex_stats_snapshot(workerPatterns[i], &stats);
+        regex_info info = regex_explain(workerPatterns[i]);
+        int ncounted = 0;
+        for (int k = 0; k < ncollected && k < 64; ++k)
+            if (collected[k].id == info.id && collected[k].digest == info.digest && collected[k].calls == NWORKERS * NWORKER_SEARCHES)
+                ncounted++;
+#ifdef REGEX_ENABLE_STATS
+        ok &= (found == 0 && stats.calls == NWORKERS * NWORKER_SEARCHES && ncounted == 1);
+#else
+        ok &= (found == -1 && stats.calls == 0 && ncollected == 0);
+#endif
+    }
+    return ok;
+}
+
+#ifdef REGEX_ENABLE_STATS
+static int same_counters(regex_stats *a, regex_stats *b)
+{
+    return a->calls == b->calls && a->bytesScanned == b->bytesScanned && a->matchAttempts == b->matchAttempts &&
+           a->matchPatternCalls == b->matchPatternCalls && a->backtrackSteps == b->backtrackSteps &&
+           a->prefilterRejects == b->prefilterRejects;
+}
+#endif
+
+int main()
+{
+    int ntests = sizeof(test_stats) / sizeof(*test_stats);
+    int nchecks = 0;
+    int nfailed = 0;
+    int length;
+    int i, j;
+    regex_stats stats;
+
+    for (i = 0; i < ntests; ++i)
+    {
+        stats_test *test = &test_stats[i];
+        regex_t pattern = regex_compile(test->pattern);
+        for (j = 0; j < test->nsearches; ++j)
+            regex_match_compiled_pattern(pattern, test->text, &length);
+
+        int found = regex_stats_snapshot(pattern, &stats);
+        nchecks++;
+#ifdef REGEX_ENABLE_STATS
+        if (found != 0 || stats.id != regex_explain(pattern).id || !same_counters(&stats, &test->expected))
+#else
+        if (found != -1 || stats.calls != 0)
+#endif
+        {
+            printf(COLOR_RED);
+            printf("[%d/%d]: pattern '%s' on '%s'\n", nchecks, ntests, test->pattern, test->text);
+            printf("Result: calls %llu bytes %llu attempts %llu matchPattern %llu backtrack %llu rejects %llu\n",
+                   (unsigned long long)stats.calls, (unsigned long long)stats.bytesScanned, (unsigned long long)stats.matchAttempts,
+                   (unsigned long long)stats.matchPatternCalls, (unsigned long long)stats.backtrackSteps, (unsigned long long)stats.prefilterRejects);
+            printf("Expected: calls %llu bytes %llu attempts %llu matchPattern %llu backtrack %llu rejects %llu\n\n",
+                   (unsigned long long)test->expected.calls, (unsigned long long)test->expected.bytesScanned, (unsigned long long)test->expected.matchAttempts,
+                   (unsigned long long)test->expected.matchPatternCalls, (unsigned long long)test->expected.backtrackSteps, (unsigned long long)test->expected.prefilterRejects);
+            nfailed++;
+        }
+        else
+        {
+            printf(COLOR_GREEN);
+            printf("[%d/%d]: pattern '%s' on '%s' counted as expected\n", nchecks, ntests, test->pattern, test->text);
+        }
+    }
+
+    regex_stats collected[16];
+    int ncollected = regex_stats_collect(collected, 16);
+
+    /* a new compile, regex_match and a loaded image of the same pattern all add to the same entry */
+    unsigned char image[REGEX_IMAGE_SIZE];
+    regex_save(regex_compile("error"), image, sizeof(image));
+    uint32_t aligned[REGEX_IMAGE_SIZE / sizeof(uint32_t) + 1]; // regex_load reads the image in place
+    memcpy(aligned, image, REGEX_IMAGE_SIZE);
+    regex_t copy = regex_load(aligned, REGEX_IMAGE_SIZE);
+    regex_match("error", "no error", &length);
+    regex_match_compiled_pattern(copy, "errors", &length);
+    regex_stats_snapshot(copy, &stats);
+    nchecks++;
+#ifdef REGEX_ENABLE_STATS
+    if (ncollected != ntests || stats.calls != 3)
+#else
+    if (ncollected != 0 || stats.calls != 0)
+#endif
+    {
+        printf(COLOR_RED "[%d]: collected %d patterns, 'error' was counted %llu times\n", nchecks, ncollected, (unsigned long long)stats.calls);
+        nfailed++;
+    }
+
+    /* more patterns than a thread keeps pending still add up exactly */
+    char batchPatterns[REGEX_STATS_PENDING + 2][8];
+    int nbatch = REGEX_STATS_PENDING + 2;
+    int batchOk = 1;
+    for (i = 0; i < nbatch; ++i)
+        sprintf(batchPatterns[i], "p%d", i);
+    for (j = 0; j < 200; ++j)
+        for (i = 0; i < nbatch; ++i)
+            regex_match(batchPatterns[i], "p1 p2 p3", &length);
+    for (i = 0; i < nbatch; ++i)
+    {
+        regex_stats_snapshot(regex_compile(batchPatterns[i]), &stats);
+#ifdef REGEX_ENABLE_STATS
+        batchOk &= (stats.calls == 200);
+#else
+        batchOk &= (stats.calls == 0);
+#endif
+    }
+    nchecks++;
+    if (!batchOk || regex_stats_dropped() != 0)
+    {
+        printf(COLOR_RED "[%d]: pending counters did not add up, %llu searches dropped\n", nchecks, (unsigned long long)regex_stats_dropped());
+        nfailed++;
+    }
+
+    /* these two patterns have the same id, the digest keeps their counters apart */
+    regex_t first = regex_compile("k110352");
+    regex_info firstInfo = regex_explain(first);
+    regex_match_compiled_pattern(first, "k110352", &length);
+    regex_match("k204600", "k204600", &length);
+    regex_match("k204600", "k204600", &length);
+    regex_t second = regex_compile("k204600");
+    regex_info secondInfo = regex_explain(second);
+    regex_stats secondStats;
+    regex_stats_snapshot(second, &secondStats);
+    regex_stats_snapshot(regex_compile("k110352"), &stats);
+    nchecks++;
+#ifdef REGEX_ENABLE_STATS
+    if (firstInfo.id != secondInfo.id || firstInfo.digest == secondInfo.digest || stats.calls != 1 ||
+        secondStats.calls != 2 || secondStats.digest != secondInfo.digest)
+#else
+    /* without statistics regex_compile does not hash the tokens at all */
+    if (firstInfo.id != 0 || secondInfo.digest != 0 || stats.calls != 0 || secondStats.calls != 0)
+#endif
+    {
+        printf(COLOR_RED "[%d]: patterns with the same id were counted %llu and %llu times\n", nchecks,
+               (unsigned long long)stats.calls, (unsigned long long)secondStats.calls);
+        nfailed++;
+    }
+
+    /* reset one pattern, then all of them */
+    regex_stats_reset(copy);
+    regex_stats_snapshot(copy, &stats);
+    int resetOne = (stats.calls == 0);
+    regex_stats_snapshot(regex_compile("^GET"), &stats);
+    int keptOther = (stats.calls == 3);
+    regex_stats_reset(NULL);
+    regex_stats_snapshot(regex_compile("^GET"), &stats);
+    int resetAll = (stats.calls == 0);
+    nchecks++;
+#ifdef REGEX_ENABLE_STATS
+    if (!resetOne || !keptOther || !resetAll)
+#else
+    if (!resetOne || keptOther || !resetAll)
+#endif
+    {
+        printf(COLOR_RED "[%d]: reset one %d, kept the others %d, reset all %d\n", nchecks, resetOne, keptOther, resetAll);
+        nfailed++;
+    }
+
+    /* counts of threads that are idle, and then gone, without flushing are seen by main;
+       regex_compile reuses one buffer, so each worker pattern gets its own loaded image */
+    static uint32_t workerImages[NWORKER_PATTERNS][REGEX_IMAGE_SIZE / sizeof(uint32_t) + 1];
+    char workerPattern[16];
+    pthread_t workers[NWORKERS];
+    for (i = 0; i < NWORKER_PATTERNS; ++i)
+    {
+        sprintf(workerPattern, "id=\\d+%c?", 'a' + i);
+        regex_save(regex_compile(workerPattern), workerImages[i], REGEX_IMAGE_SIZE);
+        workerPatterns[i] = regex_load(workerImages[i], REGEX_IMAGE_SIZE);
+    }
+    for (i = 0; i < NWORKERS; ++i)
+        pthread_create(&workers[i], NULL, worker, NULL);
+    pthread_mutex_lock(&workerLock);
+    while (workersDone < NWORKERS)
+        pthread_cond_wait(&workerCond, &workerLock);
+    pthread_mutex_unlock(&workerLock);
+    int whileIdle = workers_counted();
+    pthread_mutex_lock(&workerLock);
+    workersReleased = 1;
+    pthread_cond_broadcast(&workerCond);
+    pthread_mutex_unlock(&workerLock);
+    for (i = 0; i < NWORKERS; ++i)
+        pthread_join(workers[i], NULL);
+    int afterExit = workers_counted();
+    nchecks++;
+    if (!whileIdle || !afterExit)
+    {
+        printf(COLOR_RED "[%d]: counters of other threads, while they wait %d, after they exit %d\n", nchecks, whileIdle, afterExit);
+        nfailed++;
+    }
+
+    printf(COLOR_RESET);
+    printf(COLOR_GREEN "%d/%d test cases passed.\n" COLOR_RESET, nchecks - nfailed, nchecks);
+    if(nfailed)
+        printf(COLOR_RED "%d/%d test cases failed.\n" COLOR_RESET, nfailed, nchecks);
+
+    return nfailed;
+}
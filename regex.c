@@ -7,6 +7,95 @@ static int matchStar(regex_token token, regex_token* compiledPattern, const char
 static int matchPlus(regex_token token, regex_token* compiledPattern, const char* inputText, int* matchedLength); // helper function for matching plus (+) regex operator which means match one or more occurences
 static int matchQuestion(regex_token token, regex_token* compiledPattern, const char* inputText, int* matchedLength); // helper function for matching Question (?) regex operator which means match zero or one occurences
 static int matchSingleCharacter(regex_token token, char character); // matches single character based on the given token
+static int matchSequence(regex_token* compiledPattern, const char* inputText, int* matchedLength); // matches the tokens one by one, used by matchPattern
+static void memoBegin(regex_t compiledPattern); // turns on memoization for a search if the pattern needs it
+static void memoAttempt(const char* start); // tells the memoization that a new match attempt starts here
+static void memoAllocate(void); // allocates the bitset once the current attempt backtracked enough to need it
+static void memoEnd(void); // releases the memoization state after a search
+static void analyzePattern(regex_program* program); // fills in the regex_info of a compiled pattern and picks its engine
+static int ambiguousRun(regex_token* tokens); // longest chain of quantifiers that can trade characters with each other
+static void hashPattern(regex_program* program); // fills in the id and digest that key the statistics of a pattern
+static int tokensOverlap(regex_token first, regex_token second); // whether some character matches both tokens
+static int findMatch(regex_t compiledPattern, const char* text, int* matchLength); // runs the engine of the pattern on the text
+static int findLiteral(const regex_info* info, const char* text, int* matchLength); // engine for patterns that are plain text
+static int findBacktracking(regex_token* tokens, const regex_info* info, const char* text, int* matchLength); // engine using matchPattern
+static int runAutomaton(regex_token* tokens, const char* text, int anchored, int* matchLength); // engine simulating the tokens as an automaton
+static uint32_t imageChecksum(const regex_program* program); // checksum stored in the image header
+static int canonicalProgram(const regex_program* program, regex_program* canonical); // the exact bytes an image of the program holds
+static int validInfo(const regex_program* program); // whether the stored regex_info agrees with the tokens
+
+#if defined(_MSC_VER)
+#define REGEX_THREAD_LOCAL __declspec(thread)
+#else
+#define REGEX_THREAD_LOCAL _Thread_local
+#endif
+
+#ifdef REGEX_ENABLE_STATS
+// Every search counts into searchStats, which belongs to the thread running it, so the hot path only does plain additions.
+// When the search ends they are added to the thread's entry for the pattern in its statsBlock, under the lock of the
+// block, which only readers ever take as well. The shared statsTable is only touched when the thread needs the entry for
+// another pattern. The readers lock every block and move what it holds to statsTable before they look at it, so they see
+// every finished search, also of threads that are idle or have exited.
+typedef struct statsSlot {
+    _Atomic uint64_t key; // statsKey of the pattern, 0 while the slot is free
+    _Atomic uint64_t calls;
+    _Atomic uint64_t bytesScanned;
+    _Atomic uint64_t matchAttempts;
+    _Atomic uint64_t matchPatternCalls;
+    _Atomic uint64_t backtrackSteps;
+    _Atomic uint64_t prefilterRejects;
+    _Atomic uint64_t wallTimeNs;
+} statsSlot;
+
+static statsSlot statsTable[REGEX_STATS_SLOTS];
+
+// the counters one thread has not moved to statsTable yet. Blocks are never freed, a thread takes a free one for its
+// first search and gives it back in regex_stats_flush, a thread that exits without calling it keeps its block
+typedef struct statsBlock {
+    regex_stats pending[REGEX_STATS_PENDING]; // entries with id and digest 0 are free
+    _Atomic int lock;         // held while the entries change
+    _Atomic int used;         // a thread owns the block
+    int pendingNext;          // the entry given to the next new pattern, round robin, only used by the owner
+    struct statsBlock* next;  // every block ever allocated, newest first
+    char padding[64];         // keeps the next block off the cache lines of this one
+} statsBlock;
+
+static _Atomic(statsBlock*) statsBlocks;
+
+// the id and digest together identify a pattern in statsTable, claimed with one compare and swap
+#define statsKey(id, digest) (((uint64_t)(id) << 32) | (uint64_t)(digest))
+static _Atomic uint64_t statsDropped; // searches that could not be counted because statsTable was full
+static REGEX_THREAD_LOCAL regex_stats searchStats;
+static REGEX_THREAD_LOCAL statsBlock* statsOwn; // the block of the calling thread, NULL until its first search
+
+static void statsBegin(void); // starts counting a search
+static void statsEnd(regex_t compiledPattern); // adds the counters of the search to the thread's entry for the pattern
+static void statsMove(regex_stats* pending); // moves the counters of an entry to statsTable, its block has to be locked
+static statsBlock* statsLockAll(void); // locks every block and moves its counters to statsTable
+static void statsUnlockAll(statsBlock* blocks); // unlocks the blocks statsLockAll locked
+#define STATS_ADD(counter, n) (searchStats.counter += (uint64_t)(n))
+#else
+#define statsBegin() ((void)0)
+#define statsEnd(compiledPattern) ((void)0)
+#define STATS_ADD(counter, n) ((void)0)
+#endif
+
+// The backtracking can blow up exponentially with several quantifiers in a row (like a?a?a?aaa against "aaaa...").
+// Whether matchPattern succeeds only depends on the token index and the text position it starts from,
+// so once such a pair failed it will fail again. The memoization records these pairs in a bitset and skips them,
+// which keeps the same matches as plain backtracking but makes the search polynomial.
+// Most searches never backtrack much even with such a pattern, so the bitset is only allocated once an attempt has
+// entered matchPattern REGEX_MEMO_MIN_CALLS times, and it only covers the text from the start of that attempt.
+static REGEX_THREAD_LOCAL struct {
+    unsigned char* visited; // bitset of failed (token index, text position) pairs, NULL until an attempt needs it
+    regex_token* pattern;   // token indices are counted from here
+    const char* text;       // text positions are counted from here, the start of the attempt the bitset was allocated in
+    size_t textLength;      // the bitset covers positions up to text + textLength, later ones are not memoized
+    const char* attempt;    // where the current match attempt started
+    int enabled;            // the pattern and the mode allow memoization in this search
+    int calls;              // matchPattern calls left in the current attempt before the bitset is allocated
+} memo;
+static int memoMode = REGEX_MEMO_AUTO;
 
 
 // This is the main function that users call to match a pattern with the text
@@ -19,26 +108,165 @@ int regex_match(const char* pattern, const char* text, int* matchLength) {
 // This function matches a compiled regex pattern against the provided text
 int regex_match_compiled_pattern(regex_t compiledPattern, const char* text, int* matchLength) {
     *matchLength = 0;
+    int matchPosition = -1;
     if (compiledPattern != NULL) {
-        if (compiledPattern[0].type == BEGIN) { // Check if the pattern starts with a '^' (beginning anchor)
-            return matchPattern(&compiledPattern[1], text, matchLength) ? 0 : -1;
+        statsBegin();
+        memoBegin(compiledPattern);
+        matchPosition = findMatch(compiledPattern, text, matchLength);
+        memoEnd();
+        statsEnd(compiledPattern);
+    }
+    return matchPosition;
+}
+
+// Finds the leftmost match at or after text with the engine regex_compile picked for the pattern.
+// Patterns starting with '^' are only tried at text itself. Every engine returns the same match as the backtracking matcher.
+static int findMatch(regex_t compiledPattern, const char* text, int* matchLength) {
+    const regex_info* info = &compiledPattern->info;
+    regex_token* tokens = info->anchoredBegin ? &compiledPattern->tokens[1] : compiledPattern->tokens;
+
+    *matchLength = 0;
+    switch (info->engine) {
+        case REGEX_ENGINE_LITERAL:
+            return findLiteral(info, text, matchLength);
+        case REGEX_ENGINE_AUTOMATON:
+            return runAutomaton(tokens, text, info->anchoredBegin, matchLength);
+        default:
+            return findBacktracking(tokens, info, text, matchLength);
+    }
+}
+
+// Engine for patterns without any special tokens, the whole pattern is in info->literal
+static int findLiteral(const regex_info* info, const char* text, int* matchLength) {
+    const char* searchFrom = text;
+    const char* candidate;
+
+    while (1) {
+        if (info->anchoredBegin) {
+            if (searchFrom != text || strncmp(text, info->literal, info->literalLength) != 0) {
+                return -1;
+            }
+            candidate = text;
         } else {
-             // Try to match the pattern starting at each position in the text
-            int textPosition = -1;
-            do {
-                textPosition++;
-                if (matchPattern(compiledPattern, text, matchLength)) {
-                    return text[0] == '\0' ? -1 : textPosition; // if match is found return the position
-                }
-            } while (*text++ != '\0');
+            candidate = strstr(searchFrom, info->literal);
+            if (candidate == NULL) {
+                STATS_ADD(prefilterRejects, strlen(searchFrom));
+                return -1;
+            }
+            STATS_ADD(prefilterRejects, candidate - searchFrom);
+        }
+        STATS_ADD(matchAttempts, 1);
+        STATS_ADD(bytesScanned, info->literalLength);
+
+        // with '$' the literal also has to be followed by the end of the text or of the line
+        char after = candidate[info->literalLength];
+        if (!info->anchoredEnd || after == '\0' || after == '\n') {
+            *matchLength = info->literalLength;
+            return (int)(candidate - text);
+        }
+        searchFrom = candidate + 1;
+    }
+}
+
+// Engine using the backtracking matcher, every match has to start with the literal prefix,
+// so when there is one we skip straight to its occurrences instead of trying every position
+static int findBacktracking(regex_token* tokens, const regex_info* info, const char* text, int* matchLength) {
+    if (info->anchoredBegin) { // Check if the pattern starts with a '^' (beginning anchor)
+        STATS_ADD(matchAttempts, 1);
+        memoAttempt(text);
+        return matchPattern(tokens, text, matchLength) ? 0 : -1;
+    }
+
+    if (info->literalLength > 0) {
+        const char* searchFrom = text;
+        const char* candidate;
+        while ((candidate = strstr(searchFrom, info->literal)) != NULL) {
+            STATS_ADD(prefilterRejects, candidate - searchFrom);
+            STATS_ADD(matchAttempts, 1);
+            memoAttempt(candidate);
+            if (matchPattern(tokens, candidate, matchLength)) {
+                return (int)(candidate - text);
+            }
+            searchFrom = candidate + 1;
         }
+        STATS_ADD(prefilterRejects, strlen(searchFrom));
+        return -1;
     }
+
+    // Try to match the pattern starting at each position in the text
+    int textPosition = -1;
+    do {
+        textPosition++;
+        STATS_ADD(matchAttempts, 1);
+        memoAttempt(text);
+        if (matchPattern(tokens, text, matchLength)) {
+            return text[0] == '\0' ? -1 : textPosition; // if match is found return the position
+        }
+    } while (*text++ != '\0');
     return -1;
 }
 
+// sets how the backtracking matcher uses memoization, see REGEX_MEMO_AUTO in regex.h
+void regex_set_memoization(int mode) {
+    memoMode = mode;
+}
+
+// Decides whether the memoization may be used in this search, nothing is allocated yet
+static void memoBegin(regex_t compiledPattern) {
+    memo.visited = NULL;
+    memo.pattern = compiledPattern->tokens;
+    memo.enabled = compiledPattern->info.engine == REGEX_ENGINE_BACKTRACK &&
+                   (memoMode == REGEX_MEMO_ALWAYS || (memoMode == REGEX_MEMO_AUTO && compiledPattern->info.backtrackingRisk));
+}
+
+static void memoAttempt(const char* start) {
+    if (!memo.enabled) {
+        return;
+    }
+    memo.attempt = start;
+    memo.calls = (memoMode == REGEX_MEMO_ALWAYS) ? 1 : REGEX_MEMO_MIN_CALLS;
+
+    // the failed pairs stay valid for later attempts, but once the attempts moved past the middle of a window
+    // that was cut at REGEX_MEMO_MAX_SPAN they would mostly look beyond it, so a new one is allocated when needed
+    if (memo.visited != NULL && memo.textLength == REGEX_MEMO_MAX_SPAN && (size_t)(start - memo.text) > memo.textLength / 2) {
+        free(memo.visited);
+        memo.visited = NULL;
+    }
+}
+
+// A bit is kept for every (token index, text position) pair from the start of the current attempt, including the position
+// of the terminating '\0', but for at most REGEX_MEMO_MAX_SPAN characters, so the size does not depend on how much text is left
+static void memoAllocate(void) {
+    int ntokens = 0;
+    size_t span = 0;
+
+    while (memo.pattern[ntokens].type != UNUSED) {
+        ntokens++;
+    }
+    while (span < REGEX_MEMO_MAX_SPAN && memo.attempt[span] != '\0') {
+        span++;
+    }
+
+    size_t nbits = (size_t)(ntokens + 1) * (span + 1);
+    memo.visited = (unsigned char*)calloc((nbits + 7) / 8, 1);
+    if (!memo.visited) {
+        memo.enabled = 0; // not enough memory, fall back to plain backtracking
+        return;
+    }
+    memo.text = memo.attempt;
+    memo.textLength = span;
+}
+
+static void memoEnd(void) {
+    free(memo.visited);
+    memo.visited = NULL;
+    memo.enabled = 0;
+}
+
 // this function compiles a regex pattern string into a series of tokens for easier processing during matching
 regex_t regex_compile(const char* pattern) {
-    static regex_token compiledPattern[MAX_REGEXP_OBJECTS]; //this array stores the compiled pattern tokens
+    static regex_program program; // this stores the compiled pattern
+    regex_token* compiledPattern = program.tokens; //this array stores the compiled pattern tokens
     int i = 0, j = 0;
     int inverted = 0; // to check if character class is inverted
 
@@ -131,7 +359,176 @@ regex_t regex_compile(const char* pattern) {
         }
     }
     compiledPattern[j].type = UNUSED; // mark end of compiled pattern
-    return (regex_t)compiledPattern;
+    analyzePattern(&program);
+    return &program;
+}
+
+// Looks at the compiled tokens to find out which engine can run the pattern most cheaply.
+// Plain text is searched with strstr, patterns with several unbounded quantifiers run on the automaton
+// because they could make the backtracking blow up, and everything else is left to the backtracking matcher.
+static void analyzePattern(regex_program* program) {
+    regex_info* info = &program->info;
+    regex_token* tokens = program->tokens;
+    int nquantifiers = 0;
+    int nunbounded = 0; // quantifiers without an upper bound, '*' and '+'
+    int literalOnly = 1;
+    int inPrefix = 1;
+    int i = 0;
+
+    memset(info, 0, sizeof(*info));
+    if (tokens[0].type == BEGIN) {
+        info->anchoredBegin = 1;
+        i++;
+    }
+
+    for (; tokens[i].type != UNUSED; i++) {
+        unsigned char type = tokens[i].type;
+        unsigned char quantifier = tokens[i + 1].type;
+
+        if (type == END) { // matching stops at '$', the tokens after it are never used
+            info->anchoredEnd = 1;
+            break;
+        }
+
+        if (quantifier != STAR && quantifier != PLUS && quantifier != QUESTIONMARK) {
+            quantifier = UNUSED;
+        }
+
+        if (type == CHAR && quantifier == UNUSED && inPrefix) { // every match starts with these characters
+            info->literal[info->literalLength++] = (char)tokens[i].u.ch;
+        } else {
+            inPrefix = 0;
+        }
+        if (type != CHAR || quantifier != UNUSED) {
+            literalOnly = 0;
+        }
+
+        if (quantifier == UNUSED || quantifier == PLUS) {
+            info->minLength++;
+        }
+        if (quantifier != UNUSED) {
+            nquantifiers++;
+            if (quantifier != QUESTIONMARK) {
+                nunbounded++;
+            }
+            i++; // skip the quantifier
+        }
+    }
+    info->literal[info->literalLength] = '\0';
+
+#ifdef REGEX_ENABLE_STATS
+    hashPattern(program); // only the statistics need it, regex_save fills it in for images in any case
+#endif
+
+    if (literalOnly && info->literalLength > 0) {
+        info->engine = REGEX_ENGINE_LITERAL;
+    } else if (nunbounded >= 2) {
+        info->engine = REGEX_ENGINE_AUTOMATON;
+    } else {
+        info->engine = REGEX_ENGINE_BACKTRACK; // memoization still guards it against a run of '?'
+    }
+
+    // only the backtracking engine can blow up, and only if several quantifiers can match the same characters
+    if (info->engine == REGEX_ENGINE_BACKTRACK && nquantifiers >= REGEX_MEMO_MIN_QUANTIFIERS) {
+        info->backtrackingRisk = (ambiguousRun(&tokens[info->anchoredBegin]) >= REGEX_MEMO_MIN_QUANTIFIERS);
+    }
+}
+
+// Two independent hashes (FNV-1a and sdbm) of the used part of the tokens, the rest of the static buffer may still hold
+// an older pattern. Together they key the statistics, so two patterns only share counters if both collide.
+static void hashPattern(regex_program* program) {
+    regex_token* tokens = program->tokens;
+    uint32_t hash = 2166136261u;
+    uint32_t digest = 0;
+
+    for (int i = 0; i < MAX_REGEXP_OBJECTS; i++) {
+        unsigned char bytes[1 + MAX_CHAR_CLASS_LEN];
+        int nbytes = 0;
+
+        bytes[nbytes++] = tokens[i].type;
+        if (tokens[i].type == CHAR) {
+            bytes[nbytes++] = tokens[i].u.ch;
+        } else if (tokens[i].type == CHAR_CLASS || tokens[i].type == INV_CHAR_CLASS) {
+            for (int k = 0; tokens[i].u.char_class[k] != '\0'; k++) {
+                bytes[nbytes++] = tokens[i].u.char_class[k];
+            }
+        }
+        for (int k = 0; k < nbytes; k++) {
+            hash = (hash ^ bytes[k]) * 16777619u;
+            digest = bytes[k] + (digest << 6) + (digest << 16) - digest;
+        }
+        if (tokens[i].type == UNUSED) {
+            break;
+        }
+    }
+    program->info.id = hash ? hash : 1; // 0 marks a free slot in the statistics
+    program->info.digest = digest;
+}
+
+// The backtracking only tries the same text in many ways when a quantifier can hand characters over to a later one,
+// like in a?a?a? or \d?-?\d? (but not in https?://\S+, where ':' can never be matched by 's?').
+// A later quantifier takes over a character when every token in between can shift by one position, which is the case
+// when each of them overlaps with the token before it. '?' and '*' in between can match nothing, so they are skipped.
+// Returns the number of quantifiers in the longest chain where each one can take over from the one before it.
+static int ambiguousRun(regex_token* tokens) {
+    int units[MAX_REGEXP_OBJECTS]; // index of the token of every element of the pattern
+    unsigned char quantifiers[MAX_REGEXP_OBJECTS]; // its quantifier, UNUSED if it has none
+    int run[MAX_REGEXP_OBJECTS]; // quantifiers in the longest chain ending at the element
+    int nunits = 0;
+    int longest = 0;
+
+    for (int i = 0; tokens[i].type != UNUSED && tokens[i].type != END; i++) {
+        unsigned char quantifier = tokens[i + 1].type;
+        units[nunits] = i;
+        quantifiers[nunits] = UNUSED;
+        if (quantifier == STAR || quantifier == PLUS || quantifier == QUESTIONMARK) {
+            quantifiers[nunits] = quantifier;
+            i++; // skip the quantifier
+        }
+        run[nunits] = (quantifiers[nunits] != UNUSED);
+        nunits++;
+    }
+
+    for (int first = 0; first < nunits; first++) {
+        if (quantifiers[first] == UNUSED) {
+            continue;
+        }
+        if (run[first] > longest) {
+            longest = run[first];
+        }
+
+        regex_token previous = tokens[units[first]];
+        for (int next = first + 1; next < nunits; next++) {
+            regex_token token = tokens[units[next]];
+            int overlap = tokensOverlap(previous, token);
+            if (overlap && quantifiers[next] != UNUSED && run[first] + 1 > run[next]) {
+                run[next] = run[first] + 1;
+            }
+            if (quantifiers[next] == QUESTIONMARK || quantifiers[next] == STAR) {
+                continue;
+            }
+            if (!overlap) {
+                break; // this token can not shift, the characters after it are split the same way every time
+            }
+            previous = token;
+        }
+    }
+    return longest;
+}
+
+static int tokensOverlap(regex_token first, regex_token second) {
+    if (first.type == CHAR) {
+        return matchSingleCharacter(second, (char)first.u.ch);
+    }
+    if (second.type == CHAR) {
+        return matchSingleCharacter(first, (char)second.u.ch);
+    }
+    for (int character = 1; character < 256; character++) {
+        if (matchSingleCharacter(first, (char)character) && matchSingleCharacter(second, (char)character)) {
+            return 1;
+        }
+    }
+    return 0;
 }
 
 // Helper function to match a single character based on the token type
@@ -194,11 +591,13 @@ static int matchStar(regex_token token, regex_token* compiledPattern, const char
         inputText++;
         (*matchedLength)++;
     }
+    STATS_ADD(bytesScanned, inputText - initialText);
 
     //backtracking step 
     while (inputText >= initialText) {
         if (matchPattern(compiledPattern, inputText--, matchedLength)) return 1;
         (*matchedLength)--;
+        STATS_ADD(backtrackSteps, inputText >= initialText); // only counted when the rest is tried again
     }
     *matchedLength = initialMatchLength;// Restore initial match length if no match found
     return 0;
@@ -213,11 +612,13 @@ static int matchPlus(regex_token token, regex_token* compiledPattern, const char
         inputText++;
         (*matchedLength)++;
     }
+    STATS_ADD(bytesScanned, inputText - initialText);
 
     
     while (inputText > initialText) {
         if (matchPattern(compiledPattern, inputText--, matchedLength)) return 1;
         (*matchedLength)--;
+        STATS_ADD(backtrackSteps, inputText > initialText); // only counted when the rest is tried again
     }
     return 0;
 }
@@ -228,6 +629,7 @@ static int matchQuestion(regex_token token, regex_token* compiledPattern, const
     if (token.type == UNUSED) return 1; //try matching without current character
     if (matchPattern(compiledPattern, inputText, matchedLength)) return 1;
     if (*inputText && matchSingleCharacter(token, *inputText++)) {
+        STATS_ADD(bytesScanned, 1);
         if (matchPattern(compiledPattern, inputText, matchedLength)) {
             (*matchedLength)++;
             return 1;
@@ -238,39 +640,185 @@ static int matchQuestion(regex_token token, regex_token* compiledPattern, const
 
 // Helper function to match a pattern against the input text
 static int matchPattern(regex_token* compiledPattern, const char* inputText, int* matchedLength) {
+    size_t memoIndex = 0;
+    int memoized = 0;
+
+    STATS_ADD(matchPatternCalls, 1);
+    if (memo.visited != NULL) {
+        if (inputText >= memo.text && (size_t)(inputText - memo.text) <= memo.textLength) {
+            memoized = 1;
+            memoIndex = (size_t)(compiledPattern - memo.pattern) * (memo.textLength + 1) + (size_t)(inputText - memo.text);
+            if (memo.visited[memoIndex / 8] & (1 << (memoIndex % 8))) {
+                return 0; // this subproblem already failed
+            }
+        }
+    } else if (memo.enabled && --memo.calls == 0) {
+        memoAllocate(); // this attempt keeps backtracking, the calls from here on are memoized
+    }
+
+    int matched = matchSequence(compiledPattern, inputText, matchedLength);
+
+    if (!matched && memoized) {
+        memo.visited[memoIndex / 8] |= (unsigned char)(1 << (memoIndex % 8));
+    }
+    return matched;
+}
+
+// Helper function to match the tokens one by one, the quantifiers hand the rest of the pattern back to matchPattern
+static int matchSequence(regex_token* compiledPattern, const char* inputText, int* matchedLength) {
     int initialMatchLength = *matchedLength;
+    int matched;
 
     do {
         if (compiledPattern[0].type == UNUSED) {
             return 1;
         } else if (compiledPattern[0].type == END) {
-            return (*inputText == '\0' || *inputText == '\n');
+            matched = (*inputText == '\0' || *inputText == '\n');
+            break;
         } else if (compiledPattern[1].type == QUESTIONMARK) {
-            return matchQuestion(compiledPattern[0], &compiledPattern[2], inputText, matchedLength);
+            matched = matchQuestion(compiledPattern[0], &compiledPattern[2], inputText, matchedLength);
+            break;
         } else if (compiledPattern[1].type == STAR) {
-            return matchStar(compiledPattern[0], &compiledPattern[2], inputText, matchedLength);
+            matched = matchStar(compiledPattern[0], &compiledPattern[2], inputText, matchedLength);
+            break;
         } else if (compiledPattern[1].type == PLUS) {
-            return matchPlus(compiledPattern[0], &compiledPattern[2], inputText, matchedLength);
-        }
-        
-        if (*inputText == '\0') {
-            *matchedLength = initialMatchLength;
-            return 0;
+            matched = matchPlus(compiledPattern[0], &compiledPattern[2], inputText, matchedLength);
+            break;
         }
         
-        if (!matchSingleCharacter(*compiledPattern, *inputText)) {
-            *matchedLength = initialMatchLength;
-            return 0;
+        if (*inputText == '\0' || !matchSingleCharacter(*compiledPattern, *inputText)) {
+            matched = 0;
+            break;
         }
         
         compiledPattern++;
         inputText++;
         (*matchedLength)++;
+        STATS_ADD(bytesScanned, 1);
     } while (1);
+
+    // a failed attempt must not leave the characters matched before the quantifier in the length,
+    // otherwise the result would depend on how we got here and could not be memoized
+    if (!matched) {
+        *matchedLength = initialMatchLength;
+    }
+    return matched;
+}
+
+// The automaton engine. Since there are no groups or alternations, the tokens already form a chain of states,
+// and we simulate all of them at once like Pike's VM so every character of the text is looked at only once.
+// The threads are kept in the order the backtracking matcher would try them ('*' and '+' prefer to repeat,
+// '?' prefers to skip), so the first thread that reaches the end of the pattern gives the same match it would.
+#define AUTOMATON_ACCEPT 0xff // token index of a thread that reached the end of the pattern
+#define AUTOMATON_ACCEPT_BIT (1ULL << (2 * MAX_REGEXP_OBJECTS))
+
+typedef struct automatonThread {
+    unsigned char token; // index of the token the thread consumes next
+    unsigned char mode;  // 1 once a '+' token was consumed, from then on it repeats like '*'
+    const char* start;   // where the match of this thread started
+} automatonThread;
+
+typedef struct automatonThreadList {
+    automatonThread threads[2 * MAX_REGEXP_OBJECTS + 1];
+    int count;
+    unsigned long long added; // bit (2 * token + mode) for every thread in the list, and AUTOMATON_ACCEPT_BIT
+} automatonThreadList;
+
+// adds a thread that is about to run from the given token, following '?' and '*' (which may also be skipped) right away
+static void automatonAdd(automatonThreadList* list, regex_token* tokens, int token, int mode, const char* start, const char* inputText) {
+    unsigned char type = tokens[token].type;
+
+    if (type == UNUSED || type == END) { // like matchPattern, the match ends at '$' whatever follows it
+        if (type == END && *inputText != '\0' && *inputText != '\n') {
+            return;
+        }
+        if (!(list->added & AUTOMATON_ACCEPT_BIT)) {
+            list->added |= AUTOMATON_ACCEPT_BIT;
+            list->threads[list->count++] = (automatonThread){AUTOMATON_ACCEPT, 0, start};
+        }
+        return;
+    }
+
+    unsigned long long bit = 1ULL << (2 * token + mode);
+    if (list->added & bit) {
+        return; // a thread with higher priority is already here
+    }
+    list->added |= bit;
+
+    unsigned char quantifier = tokens[token + 1].type;
+    if (quantifier == QUESTIONMARK) { // zero occurences are tried first
+        automatonAdd(list, tokens, token + 2, 0, start, inputText);
+        list->threads[list->count++] = (automatonThread){(unsigned char)token, 0, start};
+    } else if (quantifier == STAR || (quantifier == PLUS && mode == 1)) { // another occurence is tried first
+        list->threads[list->count++] = (automatonThread){(unsigned char)token, (unsigned char)mode, start};
+        automatonAdd(list, tokens, token + 2, 0, start, inputText);
+    } else {
+        list->threads[list->count++] = (automatonThread){(unsigned char)token, (unsigned char)mode, start};
+    }
+}
+
+static int runAutomaton(regex_token* tokens, const char* text, int anchored, int* matchLength) {
+    automatonThreadList lists[2];
+    automatonThreadList* current = &lists[0];
+    automatonThreadList* next = &lists[1];
+    const char* inputText = text;
+    const char* matchStart = NULL;
+    const char* matchEnd = NULL;
+
+    current->count = 0;
+    current->added = 0;
+    while (1) {
+        // start a new attempt at this position with the lowest priority, until one of the earlier attempts matched
+        if (matchStart == NULL && (anchored ? inputText == text : *inputText != '\0')) {
+            STATS_ADD(matchAttempts, 1);
+            automatonAdd(current, tokens, 0, 0, inputText, inputText);
+        }
+        if (*inputText != '\0' && current->count > 0) {
+            STATS_ADD(bytesScanned, 1);
+        }
+
+        next->count = 0;
+        next->added = 0;
+        for (int i = 0; i < current->count; i++) {
+            automatonThread thread = current->threads[i];
+            if (thread.token == AUTOMATON_ACCEPT) {
+                matchStart = thread.start;
+                matchEnd = inputText;
+                break; // the remaining threads have lower priority
+            }
+            if (*inputText != '\0' && matchSingleCharacter(tokens[thread.token], *inputText)) {
+                unsigned char quantifier = tokens[thread.token + 1].type;
+                if (quantifier == STAR) {
+                    automatonAdd(next, tokens, thread.token, 0, thread.start, inputText + 1);
+                } else if (quantifier == PLUS) {
+                    automatonAdd(next, tokens, thread.token, 1, thread.start, inputText + 1);
+                } else if (quantifier == QUESTIONMARK) {
+                    automatonAdd(next, tokens, thread.token + 2, 0, thread.start, inputText + 1);
+                } else {
+                    automatonAdd(next, tokens, thread.token + 1, 0, thread.start, inputText + 1);
+                }
+            }
+        }
+
+        if (*inputText == '\0' || (next->count == 0 && (matchStart != NULL || anchored))) {
+            break;
+        }
+        automatonThreadList* swap = current;
+        current = next;
+        next = swap;
+        inputText++;
+    }
+
+    if (matchStart == NULL) {
+        return -1;
+    }
+    *matchLength = (int)(matchEnd - matchStart);
+    return (int)(matchStart - text);
 }
 
 // Function to print the compiled regex pattern inspired from tinyregex
-void regex_print(regex_token* compiledPattern) {
+void regex_print(regex_t compiledProgram) {
+    regex_token* compiledPattern = compiledProgram->tokens;
     const char* tokenTypes[] = {
         "UNUSED", "DOT", "BEGIN", "END", "QUESTIONMARK", "STAR", "PLUS", 
         "CHAR", "DIGIT", "NOT_DIGIT", "ALPHA", "NOT_ALPHA", "WHITESPACE", 
@@ -298,6 +846,451 @@ void regex_print(regex_token* compiledPattern) {
     }
 }
 
+// Function to explain how a compiled pattern is run, like regex_print it is meant for debugging
+regex_info regex_explain(regex_t compiledPattern) {
+    if (compiledPattern == NULL) {
+        regex_info info;
+        memset(&info, 0, sizeof(info));
+        info.engine = REGEX_ENGINE_BACKTRACK;
+        return info;
+    }
+    return compiledPattern->info;
+}
+
+// Function to get the printable name of an engine
+const char* regex_engine_name(int engine) {
+    const char* engineNames[] = {
+        "LITERAL", "BACKTRACK", "AUTOMATON"
+    };
+
+    if (engine < 0 || engine >= (int)(sizeof(engineNames) / sizeof(*engineNames))) {
+        return "UNKNOWN";
+    }
+    return engineNames[engine];
+}
+
+// Function to write the image of a compiled pattern, so it can be loaded later without compiling it again.
+size_t regex_save(regex_t compiledPattern, void* image, size_t imageSize) {
+    if (compiledPattern == NULL || image == NULL || imageSize < REGEX_IMAGE_SIZE) {
+        return 0;
+    }
+
+    regex_image_header header;
+    regex_program program;
+    memset(&header, 0, sizeof(header));
+    if (!canonicalProgram(compiledPattern, &program)) {
+        return 0;
+    }
+    hashPattern(&program); // regex_compile only works it out when statistics are compiled in, images always carry it
+
+    memcpy(header.magic, REGEX_IMAGE_MAGIC, sizeof(header.magic));
+    header.version = REGEX_IMAGE_VERSION;
+    header.byteOrder = REGEX_IMAGE_BYTE_ORDER;
+    header.programSize = (uint32_t)sizeof(regex_program);
+    header.checksum = imageChecksum(&program);
+
+    memcpy(image, &header, sizeof(header));
+    memcpy((char*)image + sizeof(header), &program, sizeof(program));
+    return REGEX_IMAGE_SIZE;
+}
+
+// Function to load the image of a compiled pattern. The image is validated but not copied, the returned
+// pattern points into it, so it can be used straight from read-only shared memory for as long as the image stays mapped.
+regex_t regex_load(const void* image, size_t imageSize) {
+    if (image == NULL || imageSize < REGEX_IMAGE_SIZE) {
+        return NULL;
+    }
+    if ((uintptr_t)image % sizeof(uint32_t) != 0) {
+        return NULL; // the header and the program are read in place, so they have to be aligned
+    }
+
+    const regex_image_header* header = (const regex_image_header*)image;
+    const regex_program* program = (const regex_program*)((const char*)image + sizeof(regex_image_header));
+
+    if (memcmp(header->magic, REGEX_IMAGE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != REGEX_IMAGE_VERSION ||
+        header->byteOrder != REGEX_IMAGE_BYTE_ORDER ||
+        header->programSize != sizeof(regex_program)) {
+        return NULL; // written by another version of the library or on another kind of machine
+    }
+    if (header->checksum != imageChecksum(program)) {
+        return NULL;
+    }
+
+    // the checksum only catches accidental damage, the program also has to be exactly what regex_save writes,
+    // and its regex_info has to agree with the tokens, otherwise it could send the matchers past the end of the text or tokens
+    regex_program canonical;
+    if (!canonicalProgram(program, &canonical) || memcmp(program, &canonical, sizeof(regex_program)) != 0 || !validInfo(program)) {
+        return NULL;
+    }
+    return (regex_t)program;
+}
+
+// FNV-1a hash over the bytes of a program
+static uint32_t imageChecksum(const regex_program* program) {
+    const unsigned char* bytes = (const unsigned char*)program;
+    uint32_t hash = 2166136261u;
+
+    for (size_t i = 0; i < sizeof(regex_program); i++) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Builds the program an image holds: only the used part of every token and of the literal is copied and everything
+// else is zero, so the same pattern always gives the same bytes.
+// Returns 0 if the tokens are not terminated or hold a value regex_compile never writes.
+static int canonicalProgram(const regex_program* program, regex_program* canonical) {
+    const regex_info* info = &program->info;
+    memset(canonical, 0, sizeof(*canonical));
+
+    for (int i = 0; i < MAX_REGEXP_OBJECTS; i++) {
+        regex_token token = program->tokens[i];
+        if (token.type > INV_CHAR_CLASS) {
+            return 0;
+        }
+        canonical->tokens[i].type = token.type;
+        if (token.type == CHAR) {
+            if (token.u.ch == '\0') {
+                return 0; // the text can not contain it, and the literal would end there
+            }
+            canonical->tokens[i].u.ch = token.u.ch;
+        } else if (token.type == CHAR_CLASS || token.type == INV_CHAR_CLASS) {
+            const unsigned char* end = memchr(token.u.char_class, '\0', MAX_CHAR_CLASS_LEN);
+            if (end == NULL) {
+                return 0;
+            }
+            int length = (int)(end - token.u.char_class);
+            for (int k = 0; k < length; k++) {
+                if (token.u.char_class[k] == '\\' && ++k == length) {
+                    return 0; // regex_compile always stores the escaped character too, matchSingleCharacter skips over both
+                }
+            }
+            memcpy(canonical->tokens[i].u.char_class, token.u.char_class, length);
+        } else if (token.type == UNUSED) {
+            if (info->literalLength < 0 || info->literalLength >= MAX_REGEXP_OBJECTS) {
+                return 0;
+            }
+            canonical->info.engine = info->engine;
+            canonical->info.anchoredBegin = info->anchoredBegin;
+            canonical->info.anchoredEnd = info->anchoredEnd;
+            canonical->info.backtrackingRisk = info->backtrackingRisk;
+            canonical->info.id = info->id;
+            canonical->info.digest = info->digest;
+            canonical->info.minLength = info->minLength;
+            canonical->info.literalLength = info->literalLength;
+            memcpy(canonical->info.literal, info->literal, info->literalLength);
+            return 1;
+        }
+    }
+    return 0; // no UNUSED token marks the end
+}
+
+// Checks the stored regex_info against the tokens without working the analysis out again. Only what the engines rely on
+// has to be exact: '^' decides where the tokens start, every match has to start with the literal, and a LITERAL pattern
+// is nothing but its literal. Which of the other engines runs a pattern, backtrackingRisk and minLength never change
+// a match, so they are only checked to be in range, and the id only to be set (0 would mark a free statistics slot).
+// The tokens have already been checked by canonicalProgram.
+static int validInfo(const regex_program* program) {
+    const regex_info* info = &program->info;
+    const regex_token* tokens = &program->tokens[info->anchoredBegin ? 1 : 0];
+
+    if (info->anchoredBegin != (program->tokens[0].type == BEGIN) || info->anchoredEnd > 1 || info->backtrackingRisk > 1 ||
+        info->engine > REGEX_ENGINE_AUTOMATON || info->minLength < 0 || info->id == 0) {
+        return 0;
+    }
+
+    // the literal comes from the first tokens, plain characters without a quantifier, which always end before UNUSED
+    for (int k = 0; k < info->literalLength; k++) {
+        if (tokens[k].type != CHAR || tokens[k].u.ch != (unsigned char)info->literal[k]) {
+            return 0;
+        }
+        unsigned char quantifier = tokens[k + 1].type;
+        if (quantifier == STAR || quantifier == PLUS || quantifier == QUESTIONMARK) {
+            return 0;
+        }
+    }
+
+    if (info->engine == REGEX_ENGINE_LITERAL) {
+        // findLiteral only looks at the literal, so nothing but '$' may follow it
+        unsigned char next = tokens[info->literalLength].type;
+        if (info->literalLength == 0 || next != (info->anchoredEnd ? END : UNUSED)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+#ifdef REGEX_ENABLE_STATS
+static uint64_t statsNow(void) {
+    struct timespec now;
+#ifdef CLOCK_MONOTONIC
+    clock_gettime(CLOCK_MONOTONIC, &now);
+#else
+    timespec_get(&now, TIME_UTC);
+#endif
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+// finds the slot counting the pattern with this key, claiming a free one if create is set
+static statsSlot* statsFind(uint64_t key, int create) {
+    for (uint32_t probe = 0; probe < REGEX_STATS_SLOTS; probe++) {
+        statsSlot* slot = &statsTable[((uint32_t)(key >> 32) + probe) & (REGEX_STATS_SLOTS - 1)];
+        uint64_t slotKey = atomic_load_explicit(&slot->key, memory_order_acquire);
+        if (slotKey == 0 && create) {
+            // another thread may claim it first, then the loaded key tells whether it was for the same pattern
+            atomic_compare_exchange_strong(&slot->key, &slotKey, key);
+            slotKey = atomic_load_explicit(&slot->key, memory_order_acquire);
+        }
+        if (slotKey == key) {
+            return slot;
+        }
+        if (slotKey == 0) {
+            return NULL;
+        }
+    }
+    return NULL; // every slot is taken, the pattern is not counted
+}
+
+static void statsBegin(void) {
+    memset(&searchStats, 0, sizeof(searchStats));
+    searchStats.wallTimeNs = statsNow();
+}
+
+static void statsLock(statsBlock* block) {
+    while (atomic_exchange_explicit(&block->lock, 1, memory_order_acquire)) {
+        // readers and the owner only hold it for a few additions
+    }
+}
+
+static void statsUnlock(statsBlock* block) {
+    atomic_store_explicit(&block->lock, 0, memory_order_release);
+}
+
+// takes a block no thread owns, or allocates a new one
+static statsBlock* statsAcquire(void) {
+    for (statsBlock* block = atomic_load_explicit(&statsBlocks, memory_order_acquire); block; block = block->next) {
+        int unused = 0;
+        if (atomic_compare_exchange_strong(&block->used, &unused, 1)) {
+            return block;
+        }
+    }
+
+    statsBlock* block = (statsBlock*)calloc(1, sizeof(statsBlock));
+    if (block == NULL) {
+        return NULL;
+    }
+    atomic_store_explicit(&block->used, 1, memory_order_relaxed);
+    block->next = atomic_load_explicit(&statsBlocks, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(&statsBlocks, &block->next, block, memory_order_release, memory_order_relaxed)) {
+        // another thread added its block first, block->next now holds it
+    }
+    return block;
+}
+
+static void statsEnd(regex_t compiledPattern) {
+    uint64_t wallTimeNs = statsNow() - searchStats.wallTimeNs;
+    uint32_t id = compiledPattern->info.id;
+    uint32_t digest = compiledPattern->info.digest;
+    regex_stats* pending = NULL;
+
+    if (statsOwn == NULL && (statsOwn = statsAcquire()) == NULL) {
+        atomic_fetch_add_explicit(&statsDropped, 1, memory_order_relaxed);
+        return;
+    }
+    statsBlock* block = statsOwn;
+
+    // readers rarely take it, so the lock is almost always on this thread's cache line already
+    statsLock(block);
+    for (int i = 0; i < REGEX_STATS_PENDING; i++) {
+        if (block->pending[i].id == id && block->pending[i].digest == digest) {
+            pending = &block->pending[i];
+            break;
+        }
+    }
+    if (pending == NULL) { // make room for the pattern, the entry may still hold another one
+        pending = &block->pending[block->pendingNext];
+        block->pendingNext = (block->pendingNext + 1) % REGEX_STATS_PENDING;
+        statsMove(pending);
+        pending->id = id;
+        pending->digest = digest;
+    }
+    pending->calls++;
+    pending->bytesScanned += searchStats.bytesScanned;
+    pending->matchAttempts += searchStats.matchAttempts;
+    pending->matchPatternCalls += searchStats.matchPatternCalls;
+    pending->backtrackSteps += searchStats.backtrackSteps;
+    pending->prefilterRejects += searchStats.prefilterRejects;
+    pending->wallTimeNs += wallTimeNs;
+    statsUnlock(block);
+}
+
+static void statsMove(regex_stats* pending) {
+    if (pending->calls == 0) {
+        return; // nothing new, do not claim a slot for it
+    }
+
+    statsSlot* slot = statsFind(statsKey(pending->id, pending->digest), 1);
+    if (slot == NULL) {
+        atomic_fetch_add_explicit(&statsDropped, pending->calls, memory_order_relaxed);
+    } else {
+        atomic_fetch_add_explicit(&slot->calls, pending->calls, memory_order_relaxed);
+        atomic_fetch_add_explicit(&slot->bytesScanned, pending->bytesScanned, memory_order_relaxed);
+        atomic_fetch_add_explicit(&slot->matchAttempts, pending->matchAttempts, memory_order_relaxed);
+        atomic_fetch_add_explicit(&slot->matchPatternCalls, pending->matchPatternCalls, memory_order_relaxed);
+        atomic_fetch_add_explicit(&slot->backtrackSteps, pending->backtrackSteps, memory_order_relaxed);
+        atomic_fetch_add_explicit(&slot->prefilterRejects, pending->prefilterRejects, memory_order_relaxed);
+        atomic_fetch_add_explicit(&slot->wallTimeNs, pending->wallTimeNs, memory_order_relaxed);
+    }
+    uint32_t id = pending->id;
+    uint32_t digest = pending->digest;
+    memset(pending, 0, sizeof(*pending));
+    pending->id = id; // the thread keeps the entry for the pattern
+    pending->digest = digest;
+}
+
+// While every block is locked no entry can move to statsTable or get another pattern, so after moving them all
+// statsTable holds every finished search until statsUnlockAll. The blocks are always locked in list order,
+// so two readers can not wait for each other, and a block added in the meantime only holds searches that ended later.
+static statsBlock* statsLockAll(void) {
+    statsBlock* blocks = atomic_load_explicit(&statsBlocks, memory_order_acquire);
+    for (statsBlock* block = blocks; block; block = block->next) {
+        statsLock(block);
+        for (int i = 0; i < REGEX_STATS_PENDING; i++) {
+            statsMove(&block->pending[i]);
+        }
+    }
+    return blocks;
+}
+
+static void statsUnlockAll(statsBlock* blocks) {
+    for (statsBlock* block = blocks; block; block = block->next) {
+        statsUnlock(block);
+    }
+}
+
+static void statsRead(statsSlot* slot, regex_stats* stats) {
+    uint64_t key = atomic_load_explicit(&slot->key, memory_order_relaxed);
+    stats->id = (uint32_t)(key >> 32);
+    stats->digest = (uint32_t)key;
+    stats->calls = atomic_load_explicit(&slot->calls, memory_order_relaxed);
+    stats->bytesScanned = atomic_load_explicit(&slot->bytesScanned, memory_order_relaxed);
+    stats->matchAttempts = atomic_load_explicit(&slot->matchAttempts, memory_order_relaxed);
+    stats->matchPatternCalls = atomic_load_explicit(&slot->matchPatternCalls, memory_order_relaxed);
+    stats->backtrackSteps = atomic_load_explicit(&slot->backtrackSteps, memory_order_relaxed);
+    stats->prefilterRejects = atomic_load_explicit(&slot->prefilterRejects, memory_order_relaxed);
+    stats->wallTimeNs = atomic_load_explicit(&slot->wallTimeNs, memory_order_relaxed);
+}
+
+static void statsClear(statsSlot* slot) {
+    atomic_store_explicit(&slot->calls, 0, memory_order_relaxed);
+    atomic_store_explicit(&slot->bytesScanned, 0, memory_order_relaxed);
+    atomic_store_explicit(&slot->matchAttempts, 0, memory_order_relaxed);
+    atomic_store_explicit(&slot->matchPatternCalls, 0, memory_order_relaxed);
+    atomic_store_explicit(&slot->backtrackSteps, 0, memory_order_relaxed);
+    atomic_store_explicit(&slot->prefilterRejects, 0, memory_order_relaxed);
+    atomic_store_explicit(&slot->wallTimeNs, 0, memory_order_relaxed);
+}
+#endif
+
+// Function to move the counters of the calling thread to the shared ones and give its block back for other threads,
+// threads that come and go should call it before they exit, otherwise their block stays taken
+void regex_stats_flush(void) {
+#ifdef REGEX_ENABLE_STATS
+    statsBlock* block = statsOwn;
+    if (block == NULL) {
+        return;
+    }
+    statsLock(block);
+    for (int i = 0; i < REGEX_STATS_PENDING; i++) {
+        statsMove(&block->pending[i]);
+        block->pending[i].id = 0;
+        block->pending[i].digest = 0;
+    }
+    block->pendingNext = 0;
+    statsUnlock(block);
+    statsOwn = NULL;
+    atomic_store_explicit(&block->used, 0, memory_order_release);
+#endif
+}
+
+// Function to get the number of searches that were not counted because every slot of the table was taken
+uint64_t regex_stats_dropped(void) {
+#ifdef REGEX_ENABLE_STATS
+    statsBlock* blocks = statsLockAll();
+    uint64_t dropped = atomic_load_explicit(&statsDropped, memory_order_relaxed);
+    statsUnlockAll(blocks);
+    return dropped;
+#else
+    return 0;
+#endif
+}
+
+// Function to read the statistics of a pattern, the counters are read one by one while other threads may keep adding
+int regex_stats_snapshot(regex_t compiledPattern, regex_stats* stats) {
+    int found = -1;
+    memset(stats, 0, sizeof(*stats));
+#ifdef REGEX_ENABLE_STATS
+    if (compiledPattern == NULL) {
+        return -1;
+    }
+    statsBlock* blocks = statsLockAll();
+    statsSlot* slot = statsFind(statsKey(compiledPattern->info.id, compiledPattern->info.digest), 0);
+    if (slot != NULL) {
+        statsRead(slot, stats);
+        found = 0;
+    }
+    statsUnlockAll(blocks);
+#else
+    (void)compiledPattern;
+#endif
+    return found;
+}
+
+// Function to read the statistics of every pattern for exporting them, only the first maxStats are stored
+int regex_stats_collect(regex_stats* stats, int maxStats) {
+    int npatterns = 0;
+#ifdef REGEX_ENABLE_STATS
+    statsBlock* blocks = statsLockAll();
+    for (int i = 0; i < REGEX_STATS_SLOTS; i++) {
+        if (atomic_load_explicit(&statsTable[i].key, memory_order_acquire) == 0) {
+            continue;
+        }
+        if (npatterns < maxStats) {
+            statsRead(&statsTable[i], &stats[npatterns]);
+        }
+        npatterns++;
+    }
+    statsUnlockAll(blocks);
+#else
+    (void)stats;
+    (void)maxStats;
+#endif
+    return npatterns;
+}
+
+// Function to reset the statistics of a pattern, or of every pattern when it is NULL
+void regex_stats_reset(regex_t compiledPattern) {
+#ifdef REGEX_ENABLE_STATS
+    statsBlock* blocks = statsLockAll();
+    if (compiledPattern == NULL) {
+        for (int i = 0; i < REGEX_STATS_SLOTS; i++) {
+            statsClear(&statsTable[i]);
+        }
+        atomic_store_explicit(&statsDropped, 0, memory_order_relaxed);
+    } else {
+        statsSlot* slot = statsFind(statsKey(compiledPattern->info.id, compiledPattern->info.digest), 0);
+        if (slot != NULL) {
+            statsClear(slot);
+        }
+    }
+    statsUnlockAll(blocks);
+#else
+    (void)compiledPattern;
+#endif
+}
+
 // Function to replace matches of a pattern in the text with a replacement string
 char* regex_replace(const char* pattern, const char* text, const char* replacement) {
     if (!pattern || !text || !replacement) {
@@ -338,4 +1331,87 @@ char* regex_replace(const char* pattern, const char* text, const char* replaceme
     }
 
     return result;
-}
\ No newline at end of file
+}
+
+// This is the multiline search, it is used for scanning log buffers where we want to know which lines matched.
+// '^' anchors at the start of every line and '$' already accepts '\n' as the end of text.
+// Instead of splitting the text and running the matcher line by line, we look for the next candidate match in the
+// whole remaining buffer and only then map it back to its line by counting newlines with memchr (which libc vectorises).
+// Every matching line is reported once, for its leftmost match. A match may continue past the end of its line
+// (for example through '\s' or '\n'), it is still reported on the line where it starts.
+// The return value is the number of matching lines, only the first maxMatches of them are stored in matches.
+int regex_match_lines_compiled_pattern(regex_t compiledPattern, const char* text, regex_line_match* matches, int maxMatches) {
+    if (compiledPattern == NULL || text == NULL) {
+        return 0;
+    }
+
+    int anchored = compiledPattern->info.anchoredBegin;
+    const char* textEnd = text + strlen(text);
+    const char* searchText = text; // where the search for the next candidate starts, always at a line start
+    const char* counted = text;    // newlines before this position are already counted
+    const char* lineStart = text;
+    int lineNumber = 1;
+    int nmatches = 0;
+
+    statsBegin();
+    memoBegin(compiledPattern);
+    while (searchText < textEnd) {
+        const char* found = NULL;
+        int matchLength = 0;
+
+        // with '^' the engine only tries the line start, otherwise it searches up to the end of the buffer, not just this line
+        int matchPosition = findMatch(compiledPattern, searchText, &matchLength);
+        if (matchPosition >= 0) {
+            found = searchText + matchPosition;
+        } else if (!anchored) {
+            // the engines never start a match at the terminating '\0', but when the last line has no '\n'
+            // that is still the end of that line, where '$' and other empty matches can match
+            matchLength = 0;
+            STATS_ADD(matchAttempts, 1);
+            memoAttempt(textEnd);
+            if (textEnd[-1] != '\n' && matchPattern(compiledPattern->tokens, textEnd, &matchLength)) {
+                found = textEnd;
+            } else {
+                break; // no match anywhere in the rest of the buffer
+            }
+        }
+
+        if (found != NULL) {
+            // map the match back to its line
+            const char* newline;
+            while ((newline = memchr(counted, '\n', found - counted)) != NULL) {
+                lineNumber++;
+                lineStart = newline + 1;
+                counted = newline + 1;
+            }
+            counted = found;
+
+            if (nmatches < maxMatches) {
+                matches[nmatches].line = lineNumber;
+                matches[nmatches].lineStart = (int)(lineStart - text);
+                matches[nmatches].position = (int)(found - text);
+                matches[nmatches].length = matchLength;
+            }
+            nmatches++;
+        } else {
+            found = searchText;
+        }
+
+        // the rest of this line can not produce another result, continue at the next line
+        const char* lineEnd = memchr(found, '\n', textEnd - found);
+        if (lineEnd == NULL) {
+            break;
+        }
+        searchText = lineEnd + 1;
+    }
+    memoEnd();
+    statsEnd(compiledPattern);
+
+    return nmatches;
+}
+
+// This function will be used by the user for multiline search, it compiles the pattern and scans the text
+int regex_match_lines(const char* pattern, const char* text, regex_line_match* matches, int maxMatches) {
+    regex_t compiledPattern = regex_compile(pattern);
+    return regex_match_lines_compiled_pattern(compiledPattern, text, matches, maxMatches);
+}
@@ -27,10 +27,36 @@
 #include <stdlib.h>
 #include <ctype.h>
 #include <string.h>
+#include <stdint.h>
+#ifdef REGEX_ENABLE_STATS
+#include <stdatomic.h>
+#include <time.h>
+#endif
 
 #define MAX_REGEXP_OBJECTS 30
 #define MAX_CHAR_CLASS_LEN 40
 
+// memoized backtracking is switched on automatically for patterns with regex_info.backtrackingRisk, that is a run of at
+// least REGEX_MEMO_MIN_QUANTIFIERS quantifiers that can match the same characters. Its bitset is only allocated once a
+// match attempt has entered matchPattern REGEX_MEMO_MIN_CALLS times, and covers at most REGEX_MEMO_MAX_SPAN characters
+// from the start of that attempt. All of them can be overridden with -D
+#ifndef REGEX_MEMO_MIN_QUANTIFIERS
+#define REGEX_MEMO_MIN_QUANTIFIERS 2
+#endif
+#ifndef REGEX_MEMO_MIN_CALLS
+#define REGEX_MEMO_MIN_CALLS 256
+#endif
+#ifndef REGEX_MEMO_MAX_SPAN
+#define REGEX_MEMO_MAX_SPAN 65536 // with MAX_REGEXP_OBJECTS tokens the bitset stays below 256 KB
+#endif
+
+// modes for regex_set_memoization
+enum {
+    REGEX_MEMO_OFF, // plain backtracking
+    REGEX_MEMO_AUTO, // memoize when the pattern and the search pass the thresholds above (default)
+    REGEX_MEMO_ALWAYS // memoize every search on REGEX_ENGINE_BACKTRACK, the other engines never backtrack
+};
+
 enum {
     UNUSED, DOT, BEGIN, END, QUESTIONMARK, STAR, PLUS, CHAR,
     DIGIT, NOT_DIGIT, ALPHA, NOT_ALPHA, WHITESPACE, NOT_WHITESPACE, CHAR_CLASS, INV_CHAR_CLASS
@@ -47,11 +73,104 @@ typedef struct regex_token {
 
 
 
-typedef struct regex_token* regex_t; // pointer to a regex token
+// engines that regex_compile can pick for a pattern, from the cheapest to the most general
+enum {
+    REGEX_ENGINE_LITERAL, // the pattern is plain text, it is searched with strstr
+    REGEX_ENGINE_BACKTRACK, // the backtracking matcher, candidates are found by skipping to the literal prefix if there is one
+    REGEX_ENGINE_AUTOMATON // the tokens are simulated as an automaton, linear in the text length
+};
+
+// what regex_compile found out about a pattern, regex_explain returns it
+typedef struct regex_info {
+    unsigned char engine;             // one of REGEX_ENGINE_*
+    unsigned char anchoredBegin;      // the pattern starts with '^'
+    unsigned char anchoredEnd;        // the pattern contains '$'
+    unsigned char backtrackingRisk;   // the pattern runs on the backtracking engine and has a run of at least
+                                      // REGEX_MEMO_MIN_QUANTIFIERS quantifiers that can match the same characters
+    uint32_t id;                      // hash of the tokens, every compile of the same pattern gets the same id
+    uint32_t digest;                  // second, independent hash of the tokens, tells patterns with the same id apart
+                                      // (regex_compile only works both out with REGEX_ENABLE_STATS, images always have them)
+    int minLength;                    // length of the shortest text the pattern can match
+    int literalLength;                // number of characters in literal
+    char literal[MAX_REGEXP_OBJECTS]; // the whole pattern for LITERAL, the literal prefix every match starts with otherwise
+} regex_info;
+
+// a compiled pattern, the tokens together with what the analysis found
+typedef struct regex_program {
+    regex_token tokens[MAX_REGEXP_OBJECTS];
+    regex_info info;
+} regex_program;
+
+typedef struct regex_program* regex_t; // pointer to a compiled pattern
+
+// A compiled pattern can be saved as an image and loaded again without running regex_compile.
+// The image is the header followed by the regex_program, which has no pointers, so it can be loaded straight
+// from a file mapped read-only at any address and shared between processes. Images of several patterns can be
+// written one after another, every image is REGEX_IMAGE_SIZE bytes so the n-th one starts at n * REGEX_IMAGE_SIZE.
+#define REGEX_IMAGE_MAGIC "RGXP"
+#define REGEX_IMAGE_VERSION 4 // bump whenever regex_token, regex_info or the meaning of the tokens change
+#define REGEX_IMAGE_BYTE_ORDER 0x0102 // written in the byte order of the compiling machine
+
+typedef struct regex_image_header {
+    char magic[4];             // REGEX_IMAGE_MAGIC
+    uint16_t version;          // REGEX_IMAGE_VERSION
+    uint16_t byteOrder;        // REGEX_IMAGE_BYTE_ORDER, reads differently on a machine with the other byte order
+    uint32_t programSize;      // sizeof(regex_program) of the compiling machine, catches a different layout
+    uint32_t checksum;         // FNV-1a hash of the regex_program bytes
+} regex_image_header;
+
+#define REGEX_IMAGE_SIZE (sizeof(regex_image_header) + sizeof(regex_program))
+
+// Runtime statistics per pattern, they are only collected when the library is compiled with -DREGEX_ENABLE_STATS,
+// otherwise the counting compiles to nothing. The counters are kept by regex_info.id and regex_info.digest rather than
+// in the pattern, so patterns loaded from read-only images are counted too and every compile of the same pattern adds
+// to the same entry. Two different patterns only share an entry if both 32-bit hashes collide (about 1 in 2^64 per pair).
+// At most REGEX_STATS_SLOTS patterns are counted, searches of further patterns are counted by regex_stats_dropped.
+// Each thread counts into its own entries for its last REGEX_STATS_PENDING patterns and moves them to the shared
+// counters when it needs an entry for another pattern. Reading or resetting moves the entries of every thread first,
+// so they see every finished search, also of threads that are idle or have exited.
+#ifndef REGEX_STATS_SLOTS
+#define REGEX_STATS_SLOTS 8192 // how many different patterns can be counted, must be a power of two
+#endif
+#ifndef REGEX_STATS_PENDING
+#define REGEX_STATS_PENDING 8 // patterns a thread keeps its own counters for at the same time
+#endif
+
+typedef struct regex_stats {
+    uint32_t id;               // regex_info.id of the pattern
+    uint32_t digest;           // regex_info.digest of the pattern
+    uint64_t calls;            // searches run with the pattern
+    uint64_t bytesScanned;     // characters consumed by the matchers, including the ones consumed again after backtracking
+    uint64_t matchAttempts;    // start positions a match was tried at
+    uint64_t matchPatternCalls; // times the backtracking matcher entered matchPattern
+    uint64_t backtrackSteps;   // times '*' or '+' gave back a character to retry the rest of the pattern
+    uint64_t prefilterRejects; // start positions the literal search skipped without running a matcher
+    uint64_t wallTimeNs;       // time spent in the searches
+} regex_stats;
+
+// describes one line of a searched buffer that contains a match
+typedef struct regex_line_match {
+    int line;       // 1-based number of the matching line
+    int lineStart;  // offset of the first character of that line in the text
+    int position;   // offset of the match in the text
+    int length;     // length of the match
+} regex_line_match;
 
 regex_t regex_compile(const char* pattern); // Compiles a regular expression pattern into a sequence of regex tokens.
 int regex_match_compiled_pattern(regex_t pattern, const char* text, int* matchlength); //Matches a regex pattern against a given text string.
 int regex_match(const char* pattern, const char* text, int* matchlength); // this function will be used by the user. it will call the regex_compile and regex_match_compiled_pattern 
 char* regex_replace(const char* pattern, const char* text, const char* replacement); // replaces a pattern with a given string
+void regex_set_memoization(int mode); // chooses when the backtracking matcher skips already failed subproblems
+int regex_match_lines_compiled_pattern(regex_t pattern, const char* text, regex_line_match* matches, int maxMatches); // multiline search, '^' and '$' anchor at every line
+int regex_match_lines(const char* pattern, const char* text, regex_line_match* matches, int maxMatches); // compiles the pattern and calls regex_match_lines_compiled_pattern
+regex_info regex_explain(regex_t pattern); // returns which engine runs the pattern and what the analysis found, like regex_print it is meant for debugging
+const char* regex_engine_name(int engine); // name of a REGEX_ENGINE_* value for printing
+size_t regex_save(regex_t pattern, void* image, size_t imageSize); // writes the image of a compiled pattern, returns REGEX_IMAGE_SIZE or 0 if it does not fit
+regex_t regex_load(const void* image, size_t imageSize); // validates an image and returns the pattern inside it without copying, NULL if it is invalid
+int regex_stats_snapshot(regex_t pattern, regex_stats* stats); // copies the counters of a pattern, returns -1 if there are none or statistics are compiled out
+int regex_stats_collect(regex_stats* stats, int maxStats); // copies the counters of every pattern, returns how many patterns have counters
+void regex_stats_reset(regex_t pattern); // sets the counters of a pattern to zero, or of all patterns when pattern is NULL
+void regex_stats_flush(void); // moves the counters the calling thread holds to the shared counters and frees its entries for other threads
+uint64_t regex_stats_dropped(void); // searches that were not counted because all REGEX_STATS_SLOTS were taken
 
 #endif